@@ -0,0 +1,52 @@
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "heapfile.h"
+
+// What the benchmarks on the heap file layer share: the record they
+// load, the globals of the layer (defined in benchutil.C) and helpers.
+
+extern Status createHeapFile(string FileName);
+extern Status createHeapFile(string FileName, const int* attrLens,
+                             const int numAttrs);
+extern Status destroyHeapFile(string FileName);
+
+typedef struct {
+    int i;
+    float f;
+    char s[64];
+} RECORD;
+
+// record i: i, i as a float and "This is record i", padded with blanks
+inline void makeRecord(RECORD & rec, const int i)
+{
+    memset(&rec, ' ', sizeof(rec));
+    sprintf(rec.s, "This is record %07d", i);
+    rec.i = i;
+    rec.f = i;
+}
+
+// n operations over the time since start, per second
+inline double perSec(const chrono::steady_clock::time_point start,
+                     const long n)
+{
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return n / elapsed.count();
+}
+
+// silence the heap file layer, which talks on cout, and make bufMgr
+void benchInit(const int numBufs);
+
+// (Re)create heap file name and insert records 0..num-1 one at a time,
+// on PAX pages of the three attributes if pax.  The RIDs go to rids
+// unless it is NULL.
+Status loadFile(const string & name, const int num, RID* rids = NULL,
+                const bool pax = false);
+
+// write name back and drop it from the OS page cache
+Status dropCache(const string & name);
+
+#endif
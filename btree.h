@@ -0,0 +1,140 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include "heapfile.h"
+
+// A B+-tree node, one page of the index file.  Leaf entries are a key
+// followed by the RID of its record; inner entries are a key and RID
+// followed by the child holding the entries not less than them.  Taking
+// the RID as part of the key lets several records have the same key and
+// lets a delete find the entry of its record.
+struct BTNode
+{
+  int	level;		// 0 for a leaf
+  int	cnt;		// entries in use
+  int	next;		// right sibling of a leaf, -1 for the last
+  int	child0;		// inner node: child holding entries before the first
+  char	data[PAGESIZE - 4 * sizeof(int)];
+};
+
+// header page of an index file, its first page
+struct BTHeader
+{
+  IndexDesc	desc;		// the indexed attribute
+  int		rootPage;
+  int		height;		// levels, 1 for a root leaf
+};
+
+// Longest STRING key: a node must hold three entries
+const int MAXKEYLEN = sizeof(((BTNode*)0)->data) / 3
+                      - sizeof(RID) - sizeof(int);
+
+// A B+-tree index of one attribute of a heap file, kept in a file of
+// its own.  STRING keys are stored with the bytes after the first NUL
+// cleared, so that comparing them with memcmp orders them as strncmp
+// does.  Deleted entries are removed from their leaf, but nodes are not
+// merged.  One scan at a time, which must not run while the index is
+// changed.
+class BTreeIndex
+{
+public:
+
+  // open the index of desc on relName
+  BTreeIndex(const string & relName, const IndexDesc & desc,
+             Status & status);
+  ~BTreeIndex();
+
+  static const string fileName(const string & relName,
+                               const IndexDesc & desc);
+
+  // Create the index file from numEntries entries, each a key (as
+  // makeKey leaves it) followed by a RID, in any order.
+  static const Status create(const string & relName, const IndexDesc & desc,
+                             char* entries, const int numEntries);
+
+  // Copy the attribute of desc in rec to key as an index key; false if
+  // rec is too short to have it.
+  static bool makeKey(const IndexDesc & desc, const Record & rec, char* key);
+
+  const IndexDesc & getDesc() const { return desc; }
+
+  // add or remove the entry of rec; records too short to have the
+  // attribute are not in the index
+  const Status insertEntry(const Record & rec, const RID & rid);
+  const Status deleteEntry(const Record & rec, const RID & rid);
+
+  // Scan the entries with lowVal lowOp key highOp highVal in key order.
+  // lowOp is GT or GTE, highOp LT or LTE; a NULL value leaves that end
+  // open.
+  const Status startScan(const char* lowVal, const Operator lowOp,
+                         const char* highVal, const Operator highOp);
+  const Status scanNext(RID & outRid);   // NOMORERECS at the end
+  const Status endScan();
+
+private:
+  File*		file;
+  BTHeader*	header;		// pinned while the index is open
+  int		headerPageNo;
+  IndexDesc	desc;
+  int		keyLen;		// bytes in a key
+  int		leafLen;	// bytes in a leaf entry
+  int		innerLen;	// bytes in an inner entry
+  int		leafCap;	// entries a leaf holds
+  int		innerCap;	// entries an inner node holds
+
+  // scan state
+  int		scanPageNo;	// leaf the scan is on, -1 if none
+  BTNode*	scanLeaf;	// pinned
+  int		scanPos;	// next entry on it
+  bool		scanHigh;	// there is an upper bound
+  Operator	highOp;
+  char		highKey[MAXKEYLEN];
+
+  static int compareKeys(const Datatype type, const int keyLen,
+                         const char* a, const char* b);
+  static int compareEntries(const Datatype type, const int keyLen,
+                            const char* a, const char* b);
+
+  char* entry(BTNode* node, const int i) const
+  {
+    return node->data + i * (node->level == 0 ? leafLen : innerLen);
+  }
+  int child(BTNode* node, const int i) const;  // i == -1 is child0
+  // index of the first entry of node greater than ent
+  int upperBound(BTNode* node, const char* ent) const;
+  // the leaf ent belongs in; the path of inner nodes down to it is
+  // appended to path
+  const Status findLeaf(const char* ent, int & leafNo,
+                        vector<int>* path = NULL);
+  // add (sep, rightNo) to the inner node pageNo, splitting it if full
+  const Status insertInner(const vector<int> & path, int depth,
+                           char* sep, int rightNo);
+};
+
+
+// A scan of a heap file in the order of one of its indexes
+class IndexScan : public HeapFile
+{
+public:
+
+  IndexScan(const string & name, Status & status);
+  ~IndexScan();
+
+  // Start a scan returning the records that satisfy all numTerms terms
+  // in the order of an index on the attribute of one of them.  The terms
+  // on that attribute bound the part of the index that is read.
+  // NOINDEX if none of the terms is on an indexed attribute.
+  const Status startScan(const ScanTerm* terms, const int numTerms);
+
+  const Status scanNext(RID & outRid);   // FILEEOF at the end
+  const Status getRecord(Record & rec);  // read current record
+  using HeapFile::getRecord;
+  const Status endScan();
+
+private:
+  BTreeIndex*	index;		// index being scanned, NULL if none
+  Predicate*	pred;
+  RID		curRid;		// last record returned
+};
+
+#endif
@@ -1,30 +1,42 @@
 #ifndef BUF_H
 #define BUF_H
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include "db.h"
 // define if debug output wanted
 //#define DEBUGBUF
 
-// declarations for buffer pool hash table
+// declarations for buffer pool hash table.  Entries are stored inline
+// in a flat array (4 per cache line); an entry with a NULL file is empty.
 struct hashBucket
 {
-	File*	file;    // pointer a file object (more on this below)
+	const File* file;    // pointer a file object (more on this below)
 	int	pageNo;  // page number within a file
 	int	frameNo; // frame number of page in the buffer pool
-	hashBucket* 	next;	 // next node in the hash table
 };
 
 
-// hash table to keep track of pages in the buffer pool
+// hash table to keep track of pages in the buffer pool.  Uses open
+// addressing with linear probing and backward-shift deletion, so no
+// tombstones accumulate.  The table is sized once for the number of
+// frames it has to map and never allocates afterwards.
 class BufHashTbl
 {
 private:
-    int HTSIZE;
-    hashBucket**  ht; // actual hash table
-    int	 hash(const File* file, const int pageNo); // returns value between 0 and HTSIZE-1
+    int HTSIZE;      // number of buckets, a power of two
+    int mask;        // HTSIZE - 1
+    int shift;       // 64 - log2(HTSIZE)
+    int numEntries;  // number of buckets in use
+    hashBucket*  ht; // actual hash table
+    int	 hash(const File* file, const int pageNo) const; // returns value between 0 and HTSIZE-1
 
 public:
-    BufHashTbl(const int htSize);  // constructor
+    BufHashTbl(const int maxEntries);  // constructor
     ~BufHashTbl(); // destructor
 	
     // insert entry into hash table mapping (file,pageNo) to frameNo;
@@ -34,7 +46,7 @@ public:
     // Check if (file,pageNo) is currently in the buffer pool (ie. in
     // the hash table).  If so, return corresponding frameNo. else return 
     // HASHNOTFOUND
-  Status lookup(const File* file, const int pageNo, int & frameNo);
+  Status lookup(const File* file, const int pageNo, int & frameNo) const;
 
     // delete entry (file,pageNo) from hash table. REturn OK if page was
     // found.  Else return HASHTBLERROR
@@ -43,18 +55,32 @@ public:
 
 
 class BufMgr;  //forward declaration of BufMgr class 
+class ClockReplacer;
+class TwoQReplacer;
 
-// class for maintaining information about buffer pool frames
+// class for maintaining information about buffer pool frames.
+// file, pageNo, dirty, valid and ioPending are only changed while
+// holding the latch of the partition that owns the frame; pinCnt and
+// refbit are atomic so that they can also be read without it.  A frame
+// whose page is being read in or written back for eviction is pinned
+// and ioPending, and stays in the hash table meanwhile, so that other
+// requests for the page wait for the I/O instead of repeating it.
 class BufDesc {
     friend class BufMgr;
+    friend class ClockReplacer;
+    friend class TwoQReplacer;
 private:
   File* file;   // pointer to file object
   int   pageNo; // page within file
   int	frameNo;  // frame # of frame
-  int   pinCnt; // number of times this page has been pinned
+  atomic<int>  pinCnt; // number of times this page has been pinned
   bool 	dirty;	  // true if dirty;  false otherwise
   bool 	valid;   // true if page is valid
-  bool  refbit;	 // has this buffer frame been reference recently
+  atomic<bool> refbit;	 // has this buffer frame been reference recently
+  const void* prefetchedBy; // who it was read ahead for, until accessed
+  bool	ioPending;	 // being read or written with the latch released
+  long	lsn;		 // log record that last changed the page, 0 if none
+  unsigned version;	 // bumped whenever the page is unpinned dirty
 
   void Clear() {  // initialize buffer frame for a new user
     	pinCnt = 0;
@@ -62,6 +88,9 @@ private:
 	pageNo = -1;
     	dirty = false;
 	valid = false;
+	prefetchedBy = NULL;
+	ioPending = false;
+	lsn = 0;
   };
 
   void Set(File* filePtr, int pageNum) { 
@@ -71,23 +100,44 @@ private:
       dirty = false;
       valid = true;
       refbit = true;
+      prefetchedBy = NULL;
+      ioPending = false;
+      lsn = 0;
   }
 
   BufDesc() {
+      frameNo = 0;
+      refbit = false;
+      version = 0;
       Clear();
   }
 };
 
 
+// counters are atomic since every partition of the pool updates them;
+// the File of each page keeps its share of them too (FileStats)
 struct BufStats
 {
-  int accesses;    // Total number of accesses to buffer pool
-  int diskreads;   // Number of pages read from disk (including allocs)
-  int diskwrites;  // Number of pages written back to disk
+  atomic<int64_t> accesses;    // Total number of accesses to buffer pool
+  atomic<int64_t> hits;        // Accesses that found the page in the pool
+  atomic<int64_t> misses;      // Accesses that read the page from disk
+  atomic<int64_t> pins;        // Pages pinned, allocations included
+  atomic<int64_t> allocs;      // New pages allocated
+  atomic<int64_t> evictions;   // Pages dropped to reuse their frame
+  atomic<int64_t> diskreads;   // Number of pages read from disk (including prefetches)
+  atomic<int64_t> diskwrites;  // Number of pages written back on eviction
+  atomic<int64_t> prefetches;  // Number of pages read ahead by the prefetcher
+  atomic<int64_t> prefetchHits;   // Number of prefetched pages later accessed
+  atomic<int64_t> prefetchWasted; // Number of prefetched pages evicted unused
+  atomic<int64_t> cleanWrites; // Number of pages written back ahead of eviction
+  atomic<int64_t> checkpointWrites; // Number of pages written by checkpoints
 
   void clear()
     {
-      accesses = diskreads = diskwrites = 0;
+      accesses = hits = misses = pins = allocs = evictions = 0;
+      diskreads = diskwrites = 0;
+      prefetches = prefetchHits = prefetchWasted = 0;
+      cleanWrites = checkpointWrites = 0;
     }
       
   BufStats()
@@ -96,46 +146,335 @@ struct BufStats
     }
 };
 
+// BufStats and the latency histograms (stats.h) at one time, for
+// export
+struct StatsSnapshot
+{
+  int64_t accesses, hits, misses, pins, allocs, evictions;
+  int64_t diskreads, diskwrites, prefetches, prefetchHits, prefetchWasted;
+  int64_t cleanWrites, checkpointWrites;
+  HistSnapshot times[NUMTIMEDOPS];
+
+  void writeJson(ostream & out) const;
+};
+
+
+// replacement policies a BufMgr can be constructed with
+enum BufPolicy { CLOCK, TWOQ };
+
+// how a page request expects to use the page; ONCE tells the
+// replacement policy that the page will not be needed again soon
+// (e.g. by a sequential scan) and should not displace hot pages
+enum AccessHint { NORMAL, ONCE };
+
+
+// Replacement policy of one buffer pool partition.  Frames are
+// numbered 0..numFrames-1 within the partition.  All calls are made
+// with the partition latch held.
+class Replacer
+{
+public:
+  virtual ~Replacer() {}
+
+  // choose a frame to reuse: either an invalid frame or an unpinned
+  // one whose page the caller will evict.  Returns BUFFEREXCEEDED if
+  // every frame is pinned.
+  virtual const Status pickVictim(int & frame) = 0;
+
+  // a page has been placed in frame
+  virtual void installed(const int frame, const File* file,
+                         const int pageNo, const AccessHint hint) = 0;
+
+  // the page in frame has been requested again
+  virtual void accessed(const int frame, const AccessHint hint) = 0;
+
+  // the page in frame has been dropped without being evicted
+  virtual void removed(const int frame) = 0;
+
+  // the page in the frame pickVictim chose is being evicted
+  virtual void evicted(const int frame) = 0;
+
+  // the frame pickVictim chose keeps its page after all (its write-back
+  // failed or it was pinned meanwhile); put it back where it was
+  virtual void restored(const int frame) = 0;
+
+  // up to max unpinned frames holding pages, about in the order they
+  // would be evicted
+  virtual void upcoming(vector<int> & frames, const int max) const = 0;
+
+  // returns a new replacer for numFrames frames described by descs
+  static Replacer* create(const BufPolicy policy, BufDesc* descs,
+                          const int numFrames);
+};
+
+
+// The clock (second chance) policy: a hand sweeps the frames and
+// evicts the first unpinned one whose reference bit is clear, clearing
+// set bits as it passes.
+class ClockReplacer : public Replacer
+{
+private:
+  BufDesc*	 descs;		// frames of the partition
+  int		 numFrames;
+  int		 clockHand;	// frame the hand points at
+
+public:
+  ClockReplacer(BufDesc* frameDescs, const int frames);
+
+  const Status pickVictim(int & frame);
+  void installed(const int frame, const File* file, const int pageNo,
+                 const AccessHint hint);
+  void accessed(const int frame, const AccessHint hint);
+  void removed(const int frame);
+  void evicted(const int frame);
+  void restored(const int frame);
+  void upcoming(vector<int> & frames, const int max) const;
+};
+
+
+// The 2Q policy (Johnson & Shasha, VLDB '94).  A page seen for the
+// first time enters the FIFO A1in; pages evicted from A1in are
+// remembered in the ghost FIFO A1out, and a page that is requested
+// again while in A1out is placed in the LRU list Am.  Pages referenced
+// only once (scans) therefore never compete with the hot pages in Am.
+// Pages installed with hint ONCE are never remembered in A1out.
+class TwoQReplacer : public Replacer
+{
+private:
+  enum { FREE, A1IN, AM, NONE };    // list a frame is on
+
+  BufDesc*	 descs;		// frames of the partition
+  int		 numFrames;
+  int		 kin;		// target size of A1in
+  int		 kout;		// capacity of A1out
+
+  // frames are linked into doubly linked lists through these arrays;
+  // heads are the eviction ends (oldest / least recently used)
+  int*		 prev;
+  int*		 next;
+  char*		 list;		// list each frame is on
+  bool*		 once;		// frame was installed with hint ONCE
+  char*		 from;		// list pickVictim took each frame off
+  int		 head[3];	// first frame of FREE, A1IN, AM or -1
+  int		 tail[3];	// last frame of each list or -1
+  int		 size[3];	// length of each list
+
+  // A1out is a ring of page ids plus a table to find them
+  hashBucket*	 ghosts;	// ring of remembered pages
+  int		 ghostHead;	// oldest entry of the ring
+  int		 ghostCnt;	// entries in the ring
+  BufHashTbl*	 ghostTbl;	// (file,pageNo) -> position in ring
+
+  void unlink(const int frame);
+  void append(const int l, const int frame);
+  void remember(const File* file, const int pageNo);
+  bool forget(const File* file, const int pageNo);
+  int  firstUnpinned(const int l) const;
+
+public:
+  TwoQReplacer(BufDesc* frameDescs, const int frames);
+  ~TwoQReplacer();
+
+  const Status pickVictim(int & frame);
+  void installed(const int frame, const File* file, const int pageNo,
+                 const AccessHint hint);
+  void accessed(const int frame, const AccessHint hint);
+  void removed(const int frame);
+  void evicted(const int frame);
+  void restored(const int frame);
+  void upcoming(vector<int> & frames, const int max) const;
+};
+
+
+// The buffer pool is split into partitions, each owning a contiguous
+// range of frames, its own hash table, replacer and latch.  A page
+// always lives in the partition its (file,pageNo) hashes to, so threads
+// working on different pages rarely contend for the same latch.
+const int MAXBUFPARTS = 16;     // upper bound on number of partitions
+const int MINPARTFRAMES = 32;   // fewest frames a partition may own
+
+struct BufPartition
+{
+  mutex		 latch;		// protects everything below and the frames
+  condition_variable ioDone;	// signalled when a frame is no longer ioPending
+  BufHashTbl*    hashTable;  	// hash table mapping (File, page) to frame
+  int		 firstFrame;	// first frame owned by this partition
+  int		 numFrames;	// number of frames owned by this partition
+  Replacer*	 replacer;	// replacement policy for the frames
+  unsigned int	 writeEpoch;	// bumped whenever a page is written back
+  int		 numDirty;	// dirty frames
+};
+
+
+// A request for the prefetcher to read pages of file into the pool, in
+// the order given.
+struct PrefetchReq
+{
+  const void*	 owner;		// scan that asked for it
+  File*		 file;
+  vector<int>	 pageNos;
+  AccessHint	 hint;		// hint the scan reads the pages with
+};
+
+const int MINREADAHEAD = 4;     // initial read-ahead window of a scan
+const int MAXPREFETCHREQS = 64; // requests queued beyond this are dropped
+
+const int WRITEBEHINDMS = 20;   // the background writer looks this often
+const int MAXWRITEBATCH = 128;  // most pages copied out for one write-back
+
+// a dirty page copied out of its frame to be written back
+struct WriteReq
+{
+  int		 frame;		// pinned until the page is written
+  File*		 file;
+  int		 pageNo;
+  unsigned	 version;	// of the frame when copied
+  long		 lsn;
+};
+
 
 class BufMgr 
 {
 private:
-  unsigned int 	 clockHand;
   int   	 numBufs;    	// Number of pages in buffer pool
-  BufHashTbl*    hashTable;  	// hash table mapping (File, page) to frame
+  int		 numParts;	// Number of partitions of the pool
+  BufPartition*  parts;		// the partitions
   BufDesc*	 bufTable;  	// vector of status info, 1 per page
   BufStats	 bufStats;	// buffer pool statistics
 
-  const Status allocBuf(int & frame);   // allocate a free frame.  
+  // allocate a free frame in partition part, whose latch lock holds;
+  // it is released while a dirty victim is written back, so what the
+  // caller looked up before must be looked up again
+  const Status allocBuf(BufPartition & part, unique_lock<mutex> & lock,
+                        int & frame);
+  // write frame back to its file, after the log records that changed it
+  const Status writeFrame(const int frame);
   const void releaseBuf(int frame); // return unused frame to end of list
-  void advanceClock()
-  {
-	clockHand = (clockHand + 1) % numBufs;
-  }
+
+  // returns the partition (file,pageNo) belongs to
+  BufPartition & partitionOf(const File* file, const int pageNo);
+  void pinFrame(BufPartition & part, const int frameNo,
+                const AccessHint hint);
+
+  // Read-ahead is done by one background thread that reads the pages
+  // asked for with the partition latches released while it does I/O.
+  atomic<int>	 maxReadAhead;	// largest read-ahead window, 0 if disabled
+  mutex		 raLatch;	// protects the fields below
+  condition_variable raCond;	// signalled on queue changes and completion
+  deque<PrefetchReq> raQueue;	// pending prefetch requests
+  const File*	 raBusyFile;	// file the prefetcher is working on
+  bool		 raShutdown;	// tells the prefetcher to exit
+  thread	 raThread;	// the prefetcher
+  mutex		 wasteLatch;	// protects raWasted; taken under a partition latch
+  map<const void*, int64_t> raWasted; // pages read ahead for each
+				// requester and evicted unused
+
+  void prefetcher();		// body of the prefetch thread
+  // bring pageNo into the pool unpinned
+  const Status prefetchPage(File* file, const int pageNo,
+                            const AccessHint hint, const void* owner);
+  // drop queued prefetches of file and wait for one in progress
+  void cancelPrefetch(const File* file);
+
+  // A background writer keeps the share of dirty frames in every
+  // partition below a target by writing back the pages that are next
+  // in line for eviction, so that a miss seldom has to write a page.
+  // Pages are copied out under the partition latch and written without
+  // it, sorted so that consecutive pages of a file go in one write.
+  atomic<int>	 dirtyTarget;	// percent of frames, 0 if disabled
+  mutex		 wbLatch;	// held while copied pages are written
+  mutex		 wbWake;	// protects wbShutdown
+  condition_variable wbCond;	// wakes the writer
+  bool		 wbShutdown;	// tells the writer to exit
+  thread	 wbThread;	// the writer
+
+  void writer();		// body of the writer thread
+  int  cleanPartitions();	// one pass of the writer; returns pages written
+  // copy frame out to be written, pinning it; part latch held
+  void copyFrame(const int frame, vector<WriteReq> & reqs,
+                 vector<Page> & copies);
+  // write the copied pages and mark them clean if unchanged since
+  const Status writeCopies(vector<WriteReq> & reqs, vector<Page> & copies);
+  int  writeBatchSize() const;
 
 
 public:
   Page*	         bufPool;   // actual buffer pool
 
-  BufMgr(const int bufs);
+  BufMgr(const int bufs, const BufPolicy policy = CLOCK);
   ~BufMgr();
 
-  const Status readPage(File* file, const int PageNo, Page*& page);
-  const Status unPinPage(File* file, const int PageNo, const bool dirty);
+  const Status readPage(File* file, const int PageNo, Page*& page,
+                        const AccessHint hint = NORMAL);
+  // like readPage, but only if the page is in the pool already;
+  // returns HASHNOTFOUND otherwise
+  const Status readResidentPage(File* file, const int PageNo, Page*& page,
+                                const AccessHint hint = NORMAL);
+  // lsn is the log record of the changes to the page, if any; the page
+  // is not written back before that record is on disk
+  const Status unPinPage(File* file, const int PageNo, const bool dirty,
+                         const long lsn = 0);
   const Status allocPage(File* file, int& PageNo, Page*& page); 
                         // allocates a new, empty page 
   const Status flushFile(const File* file); // writing out all dirty pages of the file
   const Status disposePage(File* file, const int PageNo); // dispose of page in file
   void  printSelf();
 
+  // frames of the smallest partition; pages pinned together may all
+  // hash to one, so a caller pinning many keeps to a share of this
+  int   partitionFrames() const
+  {
+	return numBufs / numParts;
+  }
+
+  // Set the largest number of pages a scan may have read ahead of it;
+  // 0 (the default) disables read-ahead.
+  void  setReadAhead(const int maxPages);
+  int   getReadAhead() const
+  {
+	return maxReadAhead;
+  }
+
+  // Asynchronously read pageNos of file into the pool so that a scan
+  // finds them already resident.  A request replaces any still queued
+  // one from the same owner, which the scan has already moved past.
+  void  prefetch(const void* owner, File* file, const vector<int> & pageNos,
+                 const AccessHint hint = NORMAL);
+  // Pages read ahead for owner that were evicted before it used them,
+  // so that a scan can size its window by its own waste.
+  int64_t prefetchWasted(const void* owner);
+  // owner is going away: drop its queued requests and its count
+  void  forgetPrefetches(const void* owner);
+
+  // Keep at most percent% of the frames of each partition dirty by
+  // writing pages back in the background; 0 (the default) stops the
+  // writer.
+  void  setDirtyTarget(const int percent);
+  int   getDirtyTarget() const
+  {
+	return dirtyTarget;
+  }
+
+  // Write back every page that is dirty when it is called, keeping the
+  // pages in the pool.  Pages are copied a batch at a time, holding each
+  // partition latch only for the copy, so readers and scans carry on.
+  // With a log, operations are held off while the dirty pages are
+  // listed and while each batch is copied; lsn is set to the end of the
+  // log when they were listed, and every change logged up to it is
+  // written on return.  The files are not synced.
+  const Status checkpoint(Log* log = NULL, long* lsn = NULL);
+
   const BufStats & getBufStats() const // get buffer pool usage
   {
 	return bufStats;
   }
+  // clears the latency histograms too
   const void clearBufStats() 
   {
 	bufStats.clear();
+	for (int op = 0; op < NUMTIMEDOPS; op++) opTimes[op].clear();
   }
+  void snapshot(StatsSnapshot & snap) const;
 };
 
 #endif
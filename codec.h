@@ -0,0 +1,20 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+// A byte-oriented LZ77 codec for page images, in the manner of LZ4: the
+// output is a sequence of literal runs, each followed by a copy of
+// earlier output given by its distance back (at most 65535 bytes) and
+// length.  A copy may overlap what it produces, so a run of one byte
+// costs a few bytes whatever its length.  Fast enough to sit under
+// every page read and write; no external library is needed.
+
+// Compress len bytes of src into dst, which has room for cap bytes.
+// Returns the compressed length, or -1 if it would exceed cap.
+int compressBytes(const char* src, const int len, char* dst, const int cap);
+
+// Decompress the len bytes of src, which must expand to exactly outLen
+// bytes, into dst.  Returns false if src is not such an image.
+bool decompressBytes(const char* src, const int len, char* dst,
+                     const int outLen);
+
+#endif
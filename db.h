@@ -2,8 +2,13 @@
 #define DB_H
 
 #include <sys/types.h>
+#include <atomic>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
 #include "error.h"
+#include "stats.h"
 #include <string.h>
 using namespace std;
 
@@ -14,21 +19,129 @@ using namespace std;
 
 // forward class definition for db
 class DB;
+class Log;
 
-// class definition for open files
+// structure of DB (header) page
+
+typedef struct {
+  int nextFree;                         // page # of next page on free list
+  int firstPage;                        // page # of first page in file
+  int numPages;                         // total # of pages in file
+  int pageSize;                         // PAGESIZE of the build that made it
+  int format;                           // FileFormat of the pages
+  int mapSector;                        // COMPRESSED: where the page map is
+  int mapEntries;                       //   and how many pages it covers
+} DBPage;
+
+// The file grows by at least this many pages at a time
+const int MINEXTENT = 64;
+
+// How a File moves pages to and from disk.  POSITIONED uses pread and
+// pwrite.  MAPPED maps the file into memory and copies pages to and
+// from the mapping, so a page read costs no system call; it also lets
+// readers use a page in place (File::mapPage).
+enum IOBackend { POSITIONED, MAPPED };
+
+// Address space reserved for the mapping of each MAPPED file.  Pages
+// beyond it are read and written with pread and pwrite.
+const size_t MAPRESERVE = (size_t)1 << 38;
+
+// When a logged operation returns (see DB::openLog).  SYNC waits until
+// its log record is on disk.  ASYNC returns at once; the log is written
+// and synced every LOGFLUSHMS milliseconds, so a crash loses at most the
+// operations of the last interval, but never leaves a file half updated.
+enum CommitMode { SYNC, ASYNC };
+
+const int LOGFLUSHMS = 10;
+
+// How a File stores its pages on disk.  RAW keeps page n at offset
+// n * PAGESIZE.  COMPRESSED runs every page but the header through
+// compressBytes (codec.h) and packs the images into runs of SECTOR byte
+// sectors after the header page; a map from page number to run is kept
+// in memory and written back with the header.  The buffer pool always
+// holds pages uncompressed.  A COMPRESSED file is never MAPPED.
+enum FileFormat { RAW, COMPRESSED };
+
+const int SECTOR = 64;
+
+// where the image of a page lives in a COMPRESSED file; sector is -1 for
+// a page never written, which reads as zeroes
+struct MapEntry {
+  int sector;                           // first sector of the run
+  int sectors;                          // length of the run
+  int length;                           // bytes of the image in it
+};
+
+// Counters of one open file, kept by the File and the buffer pool
+struct FileCounts
+{
+  int64_t hits;                         // page requests found in the pool
+  int64_t misses;                       // page requests read from the file
+  int64_t pins;                         // pages pinned, allocs included
+  int64_t allocs;                       // new pages
+  int64_t evictions;                    // pages dropped to reuse their frame
+  int64_t writeBacks;                   // dirty pages written back
+  int64_t reads;                        // pages read from disk
+  int64_t writes;                       // pages written to disk
+  int64_t bytesRead;                    // bytes moved, less than a page per
+  int64_t bytesWritten;                 //   page for COMPRESSED files
+
+  void writeJson(ostream & out) const;
+};
+
+struct FileStats
+{
+  atomic<int64_t> hits, misses, pins, allocs, evictions, writeBacks;
+  atomic<int64_t> reads, writes, bytesRead, bytesWritten;
+
+  FileStats() { clear(); }
+  void clear();
+  void snapshot(FileCounts & counts) const;
+};
+
+// class definition for open files.  Page reads and writes use
+// positioned I/O and may be issued by several threads at once;
+// allocation and disposal of pages are serialized per file.
+// While the file is open its DB header page and free list are kept in
+// memory; they are written back by flush() and when the file is closed.
 class File {
   friend class DB;
   friend class OpenFileHashTbl;
+  friend class Log;
 
  public:
 
   Status allocatePage(int& pageNo);     // allocate a new page
+  // allocate count consecutive new pages at the end of the file; the
+  // caller must write every one of them
+  Status allocateExtent(const int count, int& firstPageNo);
   const Status disposePage(const int pageNo);       // release space for a page
   const Status readPage(const int pageNo,
 		  Page* pagePtr) const;       // read page from file
   const Status writePage(const int pageNo,
 		   const Page* pagePtr);      // write page to file
+  const Status writePages(const int firstPageNo, const Page* pages,
+                          const int count);   // write consecutive pages
   const Status getFirstPage(int& pageNo) const;     // returns pageNo of first page
+  const Status flush();                 // write back header and free list
+  const Status sync();                  // wait until pages written are on disk
+
+  // the write-ahead log of the DB, NULL if there is none, and the
+  // file's id in it
+  Log* getLog() const { return log; }
+  int getLogId() const { return logId; }
+
+  // counters since the file was opened; reads and writes are also
+  // timed as FILEREAD and FILEWRITE (stats.h)
+  FileStats & getStats() const { return stats; }
+
+  // Points page at the file's own copy of pageNo, without copying it.
+  // Only for MAPPED files; returns BADPAGENO if the page is not mapped.
+  // The page stays valid until the file is closed and must not be
+  // written through.  It does not reflect changes still held in the
+  // buffer pool.
+  const Status mapPage(const int pageNo, const Page*& page) const;
+  bool isMapped() const { return mapBase != NULL; }
 
   bool operator == (const File & other) const
     {
@@ -37,10 +150,11 @@ class File {
 
  private: 
 
-  File(const string &fname);                   // initialize
+  File(const string &fname, const IOBackend backend);  // initialize
   ~File();                  // deallocate file object
 
-  static const Status create(const string &fileName);
+  static const Status create(const string &fileName,
+                             const FileFormat format = RAW);
   static const Status destroy(const string &fileName);
 
   const Status open();
@@ -50,6 +164,20 @@ class File {
 		 Page* pagePtr) const;        // internal file read
   const Status intwrite(const int pageNo,
 		  const Page* pagePtr);       // internal file write
+  const Status loadHeader();            // read header and free list
+  const Status flushHeader();           // write them back if changed
+  const Status growTo(const int pages); // make room for pages on disk
+  const Status mapTo(const int pages);  // extend the mapping to pages
+  void unmap();
+
+  // the compressed format
+  const Status loadMap();               // read the page map, rebuild free runs
+  const Status flushMap(vector<pair<int, int> > & released);
+                                        // write it to a new run if changed
+  int allocRun(const int sectors);      // first sector of a new run
+  void freeRun(const int sector, const int sectors);
+  off_t sectorOffset(const int sector) const
+    { return (off_t)sizeof(Page) + (off_t)sector * SECTOR; }
 
 #ifdef DEBUGFREE
   void listFree();                      // list free pages
@@ -58,6 +186,34 @@ class File {
   string fileName;                    // The name of the file
   int openCnt;                        // # times file has been opened
   int unixFile;                       // unix file stream for file
+  mutable mutex latch;                // serializes updates of the header page
+
+  DBPage header;                      // cached DB header page
+  bool hdrDirty;                      // header changed since last flush
+  vector<int> freeList;               // free pages, back() is reused first
+  bool freeDirty;                     // free list changed since last flush
+  int diskPages;                      // pages the file has room for on disk
+
+  IOBackend backend;
+  char* mapBase;                      // start of the reserved mapping or NULL
+  atomic<int> mapPages;               // pages mapped from mapBase on
+
+  Log* log;                           // allocations are logged here
+  int logId;
+  mutable FileStats stats;
+
+  // COMPRESSED only.  With a log, a run the map on disk refers to is
+  // not written over until a newer map is on disk: rewritten pages move
+  // to new runs and the old ones stay pending until flushHeader(), so
+  // that after a crash the old map and the log still recover the file.
+  mutable mutex pageMapLatch;         // protects the members below
+  vector<MapEntry> pageMap;           // indexed by page number
+  vector<bool> fresh;                 // run written since the last flush
+  bool pageMapDirty;
+  multimap<int, int> freeRuns;        // sectors -> first sector
+  vector<pair<int, int> > pendingRuns; // (first sector, sectors)
+  int endSector;                      // sectors in use up to here
+  int blobSector, blobSectors;        // run holding the map on disk
 };
 
 class BufMgr;
@@ -98,9 +254,10 @@ public:
 
 
 
+// All DB methods may be called concurrently.
 class DB {
  public:
-  DB();                                 // initialize open file table
+  DB(const IOBackend backend = POSITIONED);  // initialize open file table
   ~DB();                                // clean up any remaining open files
 
   const Status createFile(const string & fileName) ;  // create a new file
@@ -109,17 +266,37 @@ class DB {
   const Status openFile(const string & fileName, File* & file);  // open a file
   const Status closeFile(File* file);         // close a file
 
+  // I/O backend of the files opened from now on
+  void setIOBackend(const IOBackend backend_);
+  // on-disk format of the files created from now on
+  void setFileFormat(const FileFormat format_);
+
+  // Start logging changes to logName (see log.h), first replaying what
+  // it holds from a run that crashed.  No file may be open.  The heap
+  // file layer logs its inserts and deletes from then on.
+  const Status openLog(const string & logName, const CommitMode mode = SYNC);
+  // Stop logging, once every file is closed, and empty the log.
+  const Status closeLog();
+  Log* getLog() const { return log; }
+
+  // counters of fileName, which must be open; FILENOTOPEN otherwise
+  const Status getFileStats(const string & fileName, FileCounts & counts);
+
+  // Write back the dirty pages of the buffer pool (BufMgr::checkpoint)
+  // and, with a log, sync the files and drop the log records that are
+  // then on disk, so that the log stays short and recovery quick.
+  const Status checkpoint();
+
  private:
   OpenFileHashTbl   openFiles;    // list of open files
-};
+  mutex             latch;        // protects openFiles and open counts
+  IOBackend         backend;      // for newly opened files
+  FileFormat        format;       // for newly created files
+  Log*              log;          // write-ahead log or NULL
+  int               numOpen;      // files in openFiles
 
+  const Status syncLogged();      // sync the files the log names
+};
 
-// structure of DB (header) page
-
-typedef struct {
-  int nextFree;                         // page # of next page on free list
-  int firstPage;                        // page # of first page in file
-  int numPages;                         // total # of pages in file
-} DBPage;
 
 #endif
@@ -10,6 +10,9 @@ using namespace std;
 
 #include "page.h"
 #include "buf.h"
+#include "paxPage.h"
+#include "predicate.h"
+#include "zoneMap.h"
 
 extern DB db;
 
@@ -19,8 +22,78 @@ extern DB db;
 // Some constant definitions
 const unsigned MAXNAMESIZE = 50;
 
-enum Datatype { STRING, INTEGER, FLOAT };    // attribute data types
-enum Operator { LT, LTE, EQ, GTE, GT, NE };  // scan operators
+// The free-space map keeps one byte per page of the file, the free
+// space on the page in units of FSMUNIT bytes (0 for pages that are not
+// data pages).  It lives in FSM pages listed in the header page, each
+// covering PAGESIZE consecutive page numbers.  Only the first
+// MAXFSMPAGES*PAGESIZE pages of a file are tracked: space freed on a page
+// past them is not reused by inserts on other pages, which append instead.
+const unsigned FSMUNIT = (PAGESIZE + 255) / 256;
+const int MAXFSMPAGES = 128;
+const int FSMBUCKETS = 16;      // free space classes searched by inserts
+const int FSMPROBES = 4;        // pages tried in a class that may not fit
+
+const int BULKPAGES = 128;      // pages per write of InsertFileScan::bulkInsert
+
+// The page directory lists the data pages in chain order with their
+// record count and free space, so that a scan can go to the k-th page
+// and skip empty pages without reading them.  It is kept in directory
+// pages chained from the header page, DIRENTRIES entries to a page.
+struct DirEntry
+{
+  int		pageNo;		// data page
+  unsigned short recCnt;	// records on it
+  unsigned short freeBytes;	// Page::getFreeSpace() of it
+};
+
+const int DIRENTRIES = (PAGESIZE - sizeof(int)) / sizeof(DirEntry);
+
+struct DirPage
+{
+  int		nextPage;	// next directory page, -1 for the last
+  DirEntry	entries[DIRENTRIES];
+};
+
+// The zones of a zone map (see zoneMap.h) are kept in zone pages, the
+// zone of the data page at position k of the directory at position k of
+// the chain.  Inserts widen the zone of the page they go to; deletes
+// leave it as it is unless they empty the page.
+const int ZONEENTRIES = (PAGESIZE - sizeof(int)) / sizeof(Zone);
+
+struct ZonePage
+{
+  int		nextPage;	// next zone page, -1 for the last
+  Zone		entries[ZONEENTRIES];
+};
+
+// An attribute with a B+-tree index (see btree.h) on it
+struct IndexDesc
+{
+  int		offset;		// byte offset of attribute
+  int		length;		// length of attribute
+  Datatype	type;		// datatype of attribute
+};
+
+const int MAXINDEXES = 8;       // indexes per heap file
+
+// How the data pages of a heap file hold its records, chosen when it is
+// created.  ROWS pages are Pages.  PAX pages are PaxPages (see
+// paxPage.h), for files of fixed-width records made with
+// createHeapFile(fileName, attrLens, numAttrs): scans test an attribute
+// a minipage at a time, and records are put together when they are
+// read.
+enum HeapLayout { ROWS, PAX };
+
+class BTreeIndex;
+
+// totals over the page directory
+struct HeapStats
+{
+  int		pageCnt;	// data pages
+  int		emptyPages;	// data pages without records
+  long		recCnt;
+  long		freeBytes;
+};
 
 struct FileHdrPage
 {
@@ -29,6 +102,19 @@ struct FileHdrPage
   int		lastPage;	// pageNo of last data page in file
   int		pageCnt;	// number of pages
   int		recCnt;		// record count
+  int		fsmPageCnt;	// number of free-space map pages
+  int		fsmPages[MAXFSMPAGES];  // pageNos of free-space map pages
+  unsigned	fsmVersion;	// bumped on every change to the FSM pages
+  int		dirCnt;		// entries in the page directory
+  int		dirFirst;	// pageNo of first directory page
+  int		dirLast;	// pageNo of last directory page
+  int		indexCnt;	// number of indexes
+  IndexDesc	indexes[MAXINDEXES];	// indexed attributes
+  int		layout;		// HeapLayout of the data pages
+  int		attrCnt;	// PAX: attributes of a record
+  int		attrLens[MAXPAXATTRS];	// PAX: their lengths, in order
+  int		zoneCnt;	// number of zone maps
+  ZoneDesc	zones[MAXZONES];	// zoned attributes
 };
 
 
@@ -44,6 +130,102 @@ protected:
    int   	curPageNo;	// page number of pinned page
    bool  	curDirtyFlag;   // true if page has been updated
    RID   	curRec;         // rid of last record returned
+   bool		zeroCopy;       // use unbuffered pages in place in the mapping
+   bool		curMapped;      // curPage is in the mapping, not pinned
+
+   // In-memory copy of the free-space map, loaded when first needed and
+   // reloaded when other HeapFiles have changed it (fsmSeen is the header's
+   // fsmVersion it matches).  fsmBuckets[b] holds the pages whose class
+   // is b; fsmPos is the index of each page in its bucket, for O(1) moves.
+   bool		fsmLoaded;
+   unsigned	fsmSeen;
+   vector<unsigned char> fsmCat;
+   vector<int>	fsmPos;
+   vector<int>	fsmBuckets[FSMBUCKETS];
+
+   const Status loadFreeSpace();
+   // record that pageNo has freeBytes of free space
+   const Status setFreeSpace(const int pageNo, const int freeBytes);
+   // returns a page with at least need bytes free, or -1
+   const int findFreePage(const int need);
+
+   // directory pages in chain order and the position of each data page
+   // in the directory, loaded as far as needed
+   vector<int>	dirPageNos;
+   vector<int>	dirPos;		// indexed by pageNo, -1 if unknown
+   int		dirKnown;	// entries entered in dirPos
+   DirPage*	dirPage;	// directory page kept pinned for updates
+   int		dirPinned;	// its pageNo, -1 if none
+   bool		dirDirty;
+
+   // walk a chain of directory or zone pages from first to its k-th
+   // page; pageNos keeps the pages passed
+   const Status chainPageNo(vector<int> & pageNos, const int first,
+                            const int k, int & pageNo);
+   const Status dirPageNo(const int k, int & pageNo);  // the k-th directory page
+   const Status pinDirPage(const int pageNo);   // make it dirPage
+   const Status unpinDirPage();
+   const Status loadDirectory();
+   // add pageNo at the end of the directory, with the given zones, one
+   // for each zone map, or zones of no records if zones is NULL
+   const Status appendDirEntry(const int pageNo, const int recCnt,
+                               const int freeBytes,
+                               const Zone* zones = NULL);
+   // add recDelta to the record count of pageNo and set its free space
+   const Status updateDirEntry(const int pageNo, const int recDelta,
+                               const int freeBytes);
+   // append the entries from position from on to entries
+   const Status readDirectory(const int from, vector<DirEntry> & entries);
+
+   // the zone pages of each zone map in chain order, loaded as far as
+   // needed
+   vector<int>	zonePageNos[MAXZONES];
+   const Status appendZones(const int pos, const Zone* zones);
+   // widen the zones of pageNo to take in rec, or if rec is NULL make
+   // them zones of no records
+   const Status updateZones(const int pageNo, const Record* rec);
+   // append the zones of map z from position from up to to to zones
+   const Status readZones(const int z, const int from, const int to,
+                          vector<Zone> & zones);
+   // Set the record count of the entries from position from on to 0
+   // where the zones show that no record of the page passes the tests,
+   // so that a scan does not read those pages.
+   const Status pruneDirectory(const vector<ZoneTest> & tests,
+                               const int from,
+                               vector<DirEntry> & entries);
+
+   // the indexes listed in the header page, opened when first needed
+   vector<BTreeIndex*> indexes;
+   const Status openIndexes();
+   // add or remove the entries of a record in every index
+   const Status indexInsert(const Record & rec, const RID & rid);
+   const Status indexDelete(const Record & rec, const RID & rid);
+
+   // make pageNo the current page; the previous one must be released
+   const Status readCurPage(const int pageNo, const AccessHint hint = NORMAL);
+   const Status releaseCurPage();   // unpin the current page, if any
+   const Status pinCurPage();       // bring a mapped current page into the pool
+
+   // Page operations in the layout of the file.  pax is NULL for ROWS
+   // files.  Records of PAX pages are copied out to recBuf, or to buf,
+   // which takes recLen bytes a record; rowRid is the record in recBuf.
+   PaxLayout*	pax;
+   vector<char>	recBuf;
+   RID		rowRid;
+   void initPage(Page* page, const int pageNo) const;
+   const int freeSpace(const Page* page) const;
+   const int spaceNeeded(const int length) const;   // by a record
+   const Status firstRecord(const Page* page, RID & rid) const;
+   const Status nextRecord(const Page* page, const RID & cur,
+                           RID & next) const;
+   const Status readRecord(Page* page, const RID & rid, Record & rec);
+   // Up to max of the records of page from slotNo on that satisfy
+   // pred, which may be NULL, and their slot numbers.  slotNo is
+   // advanced past the last slot returned, or looked at if fewer than
+   // max are returned.
+   const int filterPage(Page* page, const Predicate* pred, int & slotNo,
+                        Record* recs, int* slotNos, const int max,
+                        char* buf) const;
 
 public:
 
@@ -56,8 +238,27 @@ public:
   // return number of records in file
   const int getRecCnt() const;
 
-  // given a RID, read record from file, returning pointer and length
+  // given a RID, read record from file, returning pointer and length.
+  // The record of a PAX file is a copy, valid until the next getRecord
   const Status getRecord(const RID &rid, Record & rec);
+
+  // page and record totals, from the page directory only
+  const Status getStats(HeapStats & stats);
+
+  // Build a B+-tree index on an attribute from the records of the file.
+  // Inserts and deletes keep it up to date from then on, and IndexScan
+  // uses it.  INDEXEXISTS if the attribute already has one.
+  const Status createIndex(const int offset, const int length,
+                           const Datatype type);
+
+  // Keep the smallest and largest value of an attribute for each data
+  // page, so that scans with a term on it skip the pages that cannot
+  // hold a matching record.  Zones only grow until a page is emptied,
+  // so a page whose records were deleted may still be read.
+  // INDEXEXISTS if the attribute has a zone map already, FILEHDRFULL if
+  // the file has MAXZONES.
+  const Status createZoneMap(const int offset, const int length,
+                             const Datatype type);
 };
 
 
@@ -76,28 +277,57 @@ public:
                            const char* filter, 
                            const Operator op);
 
+    // start a scan returning the records that satisfy all numTerms
+    // terms; no terms means no filtering.  Pages whose zones (see
+    // createZoneMap) show that they hold no such record are not read
+    const Status startScan(const ScanTerm* terms, const int numTerms);
+
     const Status endScan(); // terminate the scan
     const Status markScan(); // save current position of scan
     const Status resetScan(); // reset scan to last marked location
 
+    // continue the scan at the first record of the pageIdx-th data page
+    // (counting from 0 in scan order); FILEEOF if there is none
+    const Status seekPage(const int pageIdx);
+
     // return RID of next record that satisfies the scan 
     const Status scanNext(RID& outRid);
 
+    // return up to maxRecs of the next records that satisfy the scan,
+    // all from the same page.  Either array may be NULL.  The record
+    // pointers are valid until the next call that moves the scan; the
+    // last record returned becomes the current record.  Returns FILEEOF
+    // with numRecs 0 at the end of the file.
+    const Status scanNextBatch(RID* outRids, Record* outRecs,
+                               const int maxRecs, int & numRecs);
+
     // read current record, returning pointer and length
     const Status getRecord(Record & rec);
+    using HeapFile::getRecord;    // and any record by its RID
 
     // delete current record 
     const Status deleteRecord();
 
-    // marks current page of scan dirty
+    // marks current page of scan dirty; in a PAX file the current
+    // record as getRecord last returned it is written back first
     const Status markDirty();
 
+    // tell the buffer manager how the scan uses its pages; ONCE keeps a
+    // large scan from pushing hot pages out of the buffer pool
+    void setAccessHint(const AccessHint hint_);
+
+    // Read pages that are not in the buffer pool in place in the file's
+    // mapping instead of copying them into the pool; also applies to
+    // getRecord(rid, rec).  Has no effect unless the file was opened
+    // with the MAPPED I/O backend.  A page changed in the pool after the
+    // scan has reached it may not be seen.
+    void setZeroCopy(const bool on);
+
 private:
-    int   offset;            // byte offset of filter attribute
-    int   length;            // length of filter attribute
-    Datatype type;           // datatype of filter attribute
-    const char* filter;      // comparison value of filter
-    Operator op;             // comparison operator of filter
+    Predicate* pred;         // filter of the scan, NULL if none
+    vector<ZoneTest> zoneTests;  // its terms that zone maps decide
+    vector<char> batchBuf;   // PAX records returned by scanNextBatch
+    AccessHint hint;         // passed on with every page the scan reads
 
      // The following variables are used to preserve the state
     // of the scan when the method markScan() is invoked.
@@ -105,8 +335,23 @@ private:
     // scan to be rolled back to the following
     int   markedPageNo;	// page number of pinned page
     RID   markedRec;         // rid of last record returned
-
-    const bool matchRec(const Record & rec) const;
+    int   markedDirIdx;
+
+    // the part of the page directory the scan has seen, without the
+    // records of pages zoneTests rule out; curPage is the dirIdx-th entry
+    vector<DirEntry> dir;
+    int   dirIdx;
+
+    // read-ahead state, used when the buffer manager has read-ahead on
+    int   raWindow;          // pages requested per prefetch, 0 until first
+    int   raCountdown;       // pages to move before the next request
+    int64_t raWasted;        // pages of ours wasted as of the last request
+
+    const Status firstPage();  // pin the first page of the file
+    const Status nextPage();   // move to the next page, FILEEOF at the end
+    // make the first page with records from dir[idx] on current
+    const Status toPage(int idx);
+    void readAhead();        // keep prefetches running ahead of curPage
 };
 
 
@@ -121,6 +366,17 @@ public:
 
     // insert record into file, returning its RID
     const Status insertRecord(const Record & rec, RID& outRid); 
+
+    // Append numRecs records to the end of the file, packed into new
+    // pages that are written straight to disk BULKPAGES at a time
+    // without going through the buffer pool.  RIDs are returned in
+    // outRids unless it is NULL.  Call repeatedly to load a stream.
+    const Status bulkInsert(const Record* recs, const int numRecs,
+                            RID* outRids = NULL);
+
+private:
+    const Status moveTo(const int pageNo);   // make pageNo the current page
+    const Status appendPage();     // add an empty page at the end of the file
 };
 
 #endif
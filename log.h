@@ -0,0 +1,155 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "page.h"
+#include "db.h"
+
+const int LOGBUFSIZE = 1 << 20;    // a full buffer is flushed at once
+
+// kinds of log records
+enum LogRecType
+{
+  LOGNAME = 1,        // file name for an id used by later records
+  LOGCREATE,          // file created, and its FileFormat
+  LOGDROP,            // file destroyed
+  LOGALLOC,           // pages allocated at the end of a file
+  LOGPAGES            // the changes of one operation to its pages
+};
+
+// A redo-only write-ahead log.  Records are appended to a buffer in
+// memory, and one thread writes the buffer and syncs the log for all
+// the commits waiting at the time (group commit).  Positions in the
+// log (LSNs) are byte offsets of the end of records, so 0 means none.
+//
+// Every record is framed as its length, a checksum and its type; a
+// record cut short by a crash ends the log.  Replaying the log in
+// order (DB::openLog) sets every byte that was changed since the log
+// was started to its last value, so pages written back at any time
+// before the crash are brought up to date.  For that, BufMgr writes a
+// page only after the log is on disk up to the last record that
+// changed it.
+class Log
+{
+public:
+  Log(const string & name, const CommitMode mode, Status & status);
+  ~Log();                       // flushes the log
+
+  // id of fileName in the log, recorded the first time it is used
+  int fileId(const string & fileName);
+
+  // append a record; returns its LSN
+  long append(const LogRecType type, const char* data, const int len);
+
+  // wait until the log is on disk up to lsn
+  const Status flushTo(const long lsn);
+  // flushTo(lsn) if the commit mode is SYNC
+  const Status commit(const long lsn);
+  const Status flush();         // flushTo the end of the log
+  long end();                   // LSN of the last record appended
+
+  // names of the files the log has records for
+  void fileNames(vector<string> & names);
+
+  // Drop the records up to lsn from the log.  The caller must make sure
+  // that every change they record is on disk first.
+  const Status truncate(const long lsn);
+
+  // Operations (Redo) run between beginOp and endOp.  quiesce waits
+  // until none is running and holds off new ones until resume, so that
+  // pages can be copied without half an operation in them.
+  void beginOp();
+  void endOp();
+  void quiesce();
+  void resume();
+
+  // Test hook: exit the process, as a crash would, once the log has
+  // been written up to LSN size, part way through a record.
+  void setCrashPoint(const long size) { crashAt = size; }
+
+  // Replay the log in file name to the files it names.  Called before
+  // any of them is opened.
+  static const Status replay(const string & name);
+
+private:
+  string	name;
+  int		fd;
+  CommitMode	mode;
+
+  mutex		latch;		// protects everything below
+  condition_variable cond;	// signalled on flushes and new waiters
+  vector<char>	buf;		// records not yet written
+  long		appended;	// LSN of the last record appended
+  long		durable;	// log is on disk up to here
+  long		base;		// LSN of the start of the file
+  bool		flushWanted;	// a thread is waiting for the flusher
+  bool		writing;	// the flusher is writing, unlatched
+  bool		shutdown;
+  Status	error;		// first write error of the flusher
+  long		crashAt;
+  map<string, int> ids;		// file ids
+  vector<string> names;		// by id
+  thread	flusher;
+
+  mutex		opLatch;	// protects the fields below
+  condition_variable opCond;	// signalled when they change
+  int		activeOps;	// operations between beginOp and endOp
+  bool		quiescing;	// a quiesce holds off new operations
+
+  void run();			// body of the flusher thread
+  long appendLocked(const LogRecType type, const char* data, const int len);
+
+  // the files replay works on, opened once each
+  static const Status openForReplay(map<string, File*> & files,
+                                    const string & name, File*& file,
+                                    const FileFormat format = RAW);
+  static const Status closeForReplay(File* file);
+};
+
+
+// The changes one operation (an insert, a delete, ...) makes to pages,
+// collected into one LOGPAGES record so that it is replayed completely
+// or not at all.  While a Redo is active it is the current operation of
+// its thread, and code that is about to change a page calls track() on
+// it first.  The tracked pages stay pinned until end() has appended the
+// record, so none of them can be written back before the record exists.
+// A Redo created while another one is active joins that one.
+class Redo
+{
+public:
+  Redo(Log* log);               // NULL: nothing is logged
+  ~Redo();                      // end() if not done yet
+
+  // note that pageNo of file is about to change
+  static const Status track(File* file, const int pageNo);
+  // pageNo was just allocated: it is cleared and logged in full
+  static const Status trackNew(File* file, const int pageNo);
+  // pageNo has been changed already: it is logged in full
+  static const Status trackImage(File* file, const int pageNo);
+
+  static bool active();         // is there a current operation?
+
+  // append the record (and commit it) and unpin the tracked pages
+  const Status end();
+
+private:
+  struct Tracked
+  {
+    File*	file;
+    int		pageNo;
+    Page*	page;		// pinned
+    bool	image;		// log all of it
+    Page	before;		// contents when tracked
+  };
+
+  Log*		log;
+  bool		owner;		// started the current operation
+  vector<Tracked*> pages;
+
+  static const Status add(File* file, const int pageNo, const int how);
+};
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "error.h"
 #include "string.h"
+#include <type_traits>
+using namespace std;
 
 struct RID{
     int  pageNo;
@@ -17,16 +19,36 @@ struct Record
   int length;
 };
 
-// slot structure
-struct slot_t {
-        short	offset;  
-        short	length;  // equals -1 if slot is not in use
-};
+// Page size in bytes, fixed at compile time (make PAGESIZE=8192).  The
+// page classes are templates on the size, so tools can work with pages
+// of other sizes, but the buffer pool and files use this one.
+#ifndef PAGESIZE_BYTES
+#define PAGESIZE_BYTES 1024
+#endif
 
-const unsigned PAGESIZE = 1024;
-const unsigned DPFIXED= sizeof(slot_t)+4*sizeof(short)+2*sizeof(int);
-const unsigned PAGEDATASIZE = PAGESIZE-DPFIXED+sizeof(slot_t);
-// size of the data area of a page
+// Layout of a page of SIZE bytes.  Slot offsets and the page counters
+// are shorts up to 32K pages and ints above.
+template<unsigned SIZE>
+struct PageLayout
+{
+    static_assert(SIZE == 1024 || SIZE == 4096 || SIZE == 8192
+                  || SIZE == 16384 || SIZE == 65536,
+                  "page size must be 1K, 4K, 8K, 16K or 64K");
+    typedef typename conditional<(SIZE > 32768), int, short>::type Word;
+
+    // slot structure
+    struct Slot {
+        Word	offset;
+        Word	length;  // equals -1 if slot is not in use
+    };
+
+    static const unsigned FIXED = sizeof(Slot) + 4 * sizeof(Word)
+                                  + 2 * sizeof(int);
+    // size of the data area of a page
+    static const unsigned DATASIZE = SIZE - FIXED + sizeof(Slot);
+    // most slots a page can have (all records empty)
+    static const unsigned MAXSLOTS = DATASIZE / sizeof(Slot);
+};
 
 // Class definition for a minirel data page.   
 // The design assumes that records are kept compacted when
@@ -35,28 +57,46 @@ const unsigned PAGEDATASIZE = PAGESIZE-DPFIXED+sizeof(slot_t);
 // the records align, relying instead on upper levels to take
 // care of non-aligned attributes
 
-class Page {
+template<unsigned SIZE>
+class PageT {
 private:
-    char 	data[PAGESIZE - DPFIXED]; 
-    slot_t 	slot[1]; // first element of slot array - grows backwards!
-    short	slotCnt; // number of slots in use;
-    short	freePtr; // offset of first free byte in data[]
-    short	freeSpace; // number of bytes free in data[]
-    short	dummy;	// for alignment purposes
+    typedef PageLayout<SIZE> Layout;
+    typedef typename Layout::Word Word;
+    typedef typename Layout::Slot Slot;
+
+    char 	data[SIZE - Layout::FIXED]; 
+    Slot 	slot[1]; // first element of slot array - grows backwards!
+    Word	slotCnt; // number of slots in use;
+    Word	freePtr; // offset of first free byte in data[]
+    Word	freeSpace; // number of bytes free in data[]
+    Word	dummy;	// for alignment purposes
     int		nextPage; // forwards pointer
     int		curPage;  // page number of current pointer
 
+    // The slot array is indexed with negative subscripts into data[].
+    // Index through a pointer derived from the whole page, since
+    // subscripting slot[] directly lets the optimizer assume the
+    // index is always 0.
+    Slot* slotArray()
+    { return (Slot*)((char*)this + sizeof(data)); }
+    const Slot* slotArray() const
+    { return (const Slot*)((const char*)this + sizeof(data)); }
+
 public:
     void init(const int pageNo); // initialize a new page
     void dumpPage() const;       // dump contents of a page
 
     const Status getNextPage(int& pageNo) const; // returns value of nextPage
     const Status setNextPage(const int pageNo); // sets value of nextPage to pageNo
-    const short getFreeSpace() const; // returns amount of free space
+    const int getFreeSpace() const; // returns amount of free space
 
     // inserts a new record (rec) into the page, returns RID of record 
     const Status insertRecord(const Record & rec, RID& rid);
 
+    // like insertRecord but always uses a new slot, without looking for
+    // an empty one; for filling pages that have had no deletions
+    const Status appendRecord(const Record & rec, RID& rid);
+
     // delete the record with the specified rid
     const Status deleteRecord(const RID & rid);
 
@@ -70,6 +110,19 @@ public:
 
     // returns reference to record with RID rid
     const Status getRecord(const RID & rid, Record & rec);
+
+    // returns references to up to max records in the slots from slotNo
+    // on, with their slot numbers.  slotNo is advanced past the last
+    // slot looked at.  returns the number of records found
+    const int getRecords(int & slotNo, Record* recs, int* slotNos,
+                         const int max);
 };
 
+const unsigned PAGESIZE = PAGESIZE_BYTES;
+typedef PageT<PAGESIZE> Page;
+typedef PageLayout<PAGESIZE>::Slot slot_t;
+const unsigned DPFIXED = PageLayout<PAGESIZE>::FIXED;
+const unsigned PAGEDATASIZE = PageLayout<PAGESIZE>::DATASIZE;
+const unsigned MAXSLOTS = PageLayout<PAGESIZE>::MAXSLOTS;
+
 #endif
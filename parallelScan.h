@@ -0,0 +1,80 @@
+#ifndef PARALLELSCAN_H
+#define PARALLELSCAN_H
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include "heapfile.h"
+
+const int CHUNKPAGES = 8;       // pages a worker takes from the chain at once
+
+// Order in which ParallelScan passes on its results.  CHAINORDER is the
+// order of a HeapFileScan, which is RID order for a file that has only
+// grown by appending pages.
+enum ScanOrder { UNORDERED, CHAINORDER };
+
+// receives n records that satisfy the scan and their RIDs
+typedef function<void(const RID* rids, const Record* recs, const int n)>
+    ScanConsumer;
+
+// A scan of a heap file by several worker threads.  The page directory
+// is handed out CHUNKPAGES entries at a time; a worker pins and filters
+// the pages of its chunk that have records while the other workers take
+// the following chunks.  The pages of a chunk stay pinned until its
+// records have been consumed, so records are passed on in place (those
+// of a PAX file in copies kept with the chunk).
+class ParallelScan : public HeapFile
+{
+public:
+
+    ParallelScan(const string & name, Status & status);
+    ~ParallelScan();
+
+    // Pass every record that satisfies all numTerms terms (see
+    // HeapFileScan::startScan) to consumer, using numWorkers threads.
+    // UNORDERED calls consumer from the workers, concurrently, as each
+    // chunk is filtered.  CHAINORDER calls it from the calling thread
+    // only, in scan order; at most 2 * numWorkers chunks are pinned at
+    // a time.  Fewer workers and chunks are used if their pages could
+    // fill more than half a partition of the pool (partitionFrames).
+    // The records are valid only during the call.
+    const Status scan(const ScanTerm* terms, const int numTerms,
+                      const int numWorkers, const ScanOrder order,
+                      const ScanConsumer & consumer);
+
+private:
+    struct Chunk
+    {
+        int		seq;		// position in the chain
+        int		numPages;
+        int		pageNos[CHUNKPAGES];
+        Page*		pages[CHUNKPAGES];	// pinned
+        vector<RID>	rids;		// matching records
+        vector<Record>	recs;
+        vector<char>	rows;		// PAX records, put together
+    };
+
+    // state of the scan in progress, shared by the workers
+    mutex		latch;		// protects the fields up to done
+    condition_variable	cond;	// signalled when they change
+    int			nextPos;	// first directory entry not handed out
+    int			nextSeq;	// seq of the next chunk handed out
+    int			emitSeq;	// seq of the next chunk to consume
+    int			running;	// workers not finished
+    int			window;		// most chunks ahead of the merge
+    Status		error;		// first error of any worker
+    map<int, Chunk*>	done;		// filtered, waiting for the merge
+
+    vector<DirEntry>	dir;		// read when the scan starts
+    const Predicate*	pred;
+    ScanOrder		order;
+    const ScanConsumer*	consumer;
+
+    Chunk* grab();			// next chunk, NULL at the end
+    const Status pin(Chunk* chunk, const int from, const int to);
+    void release(Chunk* chunk);		// unpin and free a chunk
+    void worker();
+    void merge();			// consume chunks in order
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef PAXPAGE_H
+#define PAXPAGE_H
+
+#include "page.h"
+
+const int MAXPAXATTRS = 16;     // attributes of a PAX record
+
+// Where the attributes of the records of a PAX heap file go on a page,
+// worked out from their lengths.  Records are fixed-width: attribute a
+// is the attrLen[a] bytes at attrOff[a], and the attributes follow each
+// other.  On a page the values of attribute a of slots 0, 1, ... are
+// consecutive from byte mini[a], its minipage.
+struct PaxLayout
+{
+    int	numAttrs;
+    int	recLen;
+    int	capacity;			// slots per page
+    int	attrOff[MAXPAXATTRS];
+    int	attrLen[MAXPAXATTRS];
+    int	mini[MAXPAXATTRS];
+
+    // INVALIDRECLEN if there are no attributes, too many, or a record
+    // does not fit on a page
+    static const Status build(const int* lens, const int numAttrs,
+                              PaxLayout & layout);
+};
+
+// A data page of a PAX heap file (Partition Attributes Across).  Slot
+// numbers are positions in the minipages; a map byte per slot says
+// whether it holds a record.  A record is put together from its
+// attributes when it is read, so getRecord copies it out to buf.
+// nextPage and curPage are where Page has them, so Page::getNextPage
+// and setNextPage work on either kind of page.
+class PaxPage {
+private:
+    char	data[PAGESIZE - 4 * sizeof(int)];  // slot map, then minipages
+    int		slotCnt;	// slots from 0 up to here have been used
+    int		recCnt;		// slots holding records
+    int		nextPage;	// forwards pointer
+    int		curPage;	// page number of current pointer
+
+    const unsigned char* slotMap() const
+    { return (const unsigned char*) data; }
+    void putRecord(const PaxLayout & layout, const int slotNo,
+                   const char* rec);
+
+public:
+    void init(const int pageNo);
+
+    const Status getNextPage(int& pageNo) const;
+    const Status setNextPage(const int pageNo);
+    const int getFreeSpace(const PaxLayout & layout) const;
+    const int getSlotCnt() const { return slotCnt; }
+
+    // insert a record of layout.recLen bytes into a free slot; appendRecord
+    // always takes the slot after the last one used
+    const Status insertRecord(const PaxLayout & layout, const Record & rec,
+                              RID& rid);
+    const Status appendRecord(const PaxLayout & layout, const Record & rec,
+                              RID& rid);
+    const Status deleteRecord(const RID & rid);
+    // overwrite the record at rid with rec
+    const Status updateRecord(const PaxLayout & layout, const RID & rid,
+                              const Record & rec);
+
+    const Status firstRecord(RID& firstRid) const;
+    const Status nextRecord(const RID & curRid, RID& nextRid) const;
+
+    // copy the record at rid to buf
+    const Status getRecord(const PaxLayout & layout, const RID & rid,
+                           Record & rec, char* buf) const;
+
+    // the slot numbers of up to max records from slotNo on; slotNo is
+    // advanced past the last slot looked at.  returns their number
+    const int getSlots(int & slotNo, int* slotNos, const int max) const;
+
+    // like Page::getRecords, the records copied out one after the other
+    // to buf
+    const int getRecords(const PaxLayout & layout, int & slotNo,
+                         Record* recs, int* slotNos, const int max,
+                         char* buf) const;
+
+    // bytes offset .. offset+length-1 of the record in slot s are at
+    // column + s * stride; NULL if they are not within one attribute
+    const char* column(const PaxLayout & layout, const int offset,
+                       const int length, int & stride) const;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include "paxPage.h"
+
+enum Datatype { STRING, INTEGER, FLOAT };    // attribute data types
+enum Operator { LT, LTE, EQ, GTE, GT, NE };  // scan operators
+
+// One comparison of a scan predicate: the attribute of length bytes at
+// offset compared with the value at filter.  A STRING attribute compares
+// like strncmp(attr, filter, length), so a prefix filter is an EQ term
+// whose length is the length of the prefix.
+struct ScanTerm
+{
+  int		offset;		// byte offset of attribute
+  int		length;		// length of attribute
+  Datatype	type;		// datatype of attribute
+  const char*	filter;		// comparison value
+  Operator	op;		// comparison operator
+};
+
+// A scan predicate bound to its types and operators.  Built once when a
+// scan starts; the concrete classes are templates on the datatype and
+// operator, so evaluating one does no per-record dispatch on either.
+class Predicate
+{
+public:
+  virtual ~Predicate() {}
+
+  // true if rec satisfies the predicate
+  virtual bool match(const Record & rec) const = 0;
+
+  // sel holds the indexes of n candidate records in recs.  Keeps, in
+  // order, those that satisfy the predicate and returns their number.
+  virtual int filter(const Record* recs, int* sel, const int n) const = 0;
+
+  // The same for the records in slots sel[0..n) of a PAX page, which
+  // must be ascending.  An attribute is tested a minipage at a time.
+  virtual int filter(const PaxPage & page, const PaxLayout & layout,
+                     int* sel, const int n) const = 0;
+
+  // builds the conjunction of the terms.  A lower and an upper bound on
+  // the same attribute become a single range test.  Filter values are
+  // copied.  Returns BADSCANPARM if a term is malformed
+  static const Status create(const ScanTerm* terms, const int numTerms,
+                             Predicate*& pred);
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+using namespace std;
+
+// Latency histograms of the operations the storage engine times.
+// Timing an operation costs two clock reads, so it is off unless
+// enabled with setTiming(); the counters of the buffer pool and the
+// files (BufStats, FileStats) are always kept.
+
+const int HISTBUCKETS = 48;     // bucket b > 0 counts [2^(b-1), 2^b) ns
+
+// the operations timed
+enum TimedOp { FILEREAD, FILEWRITE, BUFREAD, SCANNEXT, NUMTIMEDOPS };
+
+extern const char* const timedOpNames[NUMTIMEDOPS];
+
+// a copy of a LatencyHist taken at one time
+struct HistSnapshot
+{
+    int64_t	counts[HISTBUCKETS];
+    int64_t	count;		// operations timed
+    int64_t	totalNs;	// time they took together
+    int64_t	maxNs;		// longest of them
+
+    // an upper bound of the latency of fraction p (0..1) of them
+    int64_t percentile(const double p) const;
+    double meanNs() const { return count > 0 ? (double) totalNs / count : 0; }
+    void writeJson(ostream & out) const;
+};
+
+// A histogram of latencies in power-of-two buckets of nanoseconds.
+// May be recorded into by any number of threads at once.
+class LatencyHist
+{
+public:
+    LatencyHist() { clear(); }
+    void record(const int64_t ns);
+    void snapshot(HistSnapshot & snap) const;
+    void clear();
+
+private:
+    atomic<int64_t> counts[HISTBUCKETS];
+    atomic<int64_t> totalNs;
+    atomic<int64_t> maxNs;
+};
+
+extern LatencyHist opTimes[NUMTIMEDOPS];
+extern atomic<bool> timingOn;
+
+void setTiming(const bool on);
+inline bool timing() { return timingOn.load(memory_order_relaxed); }
+
+inline int64_t nowNs()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Times the scope it is declared in as an op, if timing is on
+class OpTimer
+{
+public:
+    OpTimer(const TimedOp op_) : op(op_), start(timing() ? nowNs() : -1) {}
+    ~OpTimer() { if (start >= 0) opTimes[op].record(nowNs() - start); }
+
+private:
+    TimedOp	op;
+    int64_t	start;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef ZONEMAP_H
+#define ZONEMAP_H
+
+#include <vector>
+using namespace std;
+
+#include "page.h"
+#include "predicate.h"
+
+const int MAXZONES = 4;         // zone maps per heap file
+const int ZONEKEY = 8;          // bytes of a value a zone holds
+
+// The smallest and largest value of an attribute over the records of a
+// data page.  An INTEGER or FLOAT value is kept as it is; a STRING value
+// as its first ZONEKEY bytes, those after a NUL cleared, which orders
+// strings the way scans compare them.  lo > hi when no record has been
+// added.
+struct Zone
+{
+    char	lo[ZONEKEY];
+    char	hi[ZONEKEY];
+};
+
+// An attribute of a heap file with a zone map: a zone for each data
+// page, kept in a chain of zone pages in the order of the page
+// directory.
+struct ZoneDesc
+{
+    int		offset;		// byte offset of attribute
+    int		length;		// length of attribute
+    Datatype	type;		// datatype of attribute
+    int		firstPage;	// first zone page
+    int		lastPage;	// last zone page
+
+    void clear(Zone & zone) const;      // make it the zone of no records
+    // widen zone to take in the attribute of rec.  A record too short
+    // to hold it is left out, as no scan term on it can match
+    void add(Zone & zone, const Record & rec) const;
+};
+
+// A scan term on an attribute with a zone map, tested against the zone
+// of a page to see whether any record on the page can satisfy it.
+struct ZoneTest
+{
+    int		zone;		// index of the zone map
+    Datatype	type;
+    Operator	op;
+    int		keyLen;		// STRING: bytes of the zones compared
+    char	key[ZONEKEY];	// the filter value, as a zone holds it
+
+    // false only if no value within zone satisfies the term
+    bool mayMatch(const Zone & zone) const;
+
+    // the tests of those of the (valid) terms that are on one of the
+    // numZones zoned attributes of descs
+    static void make(const ZoneDesc* descs, const int numZones,
+                     const ScanTerm* terms, const int numTerms,
+                     vector<ZoneTest> & tests);
+};
+
+#endif